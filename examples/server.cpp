@@ -5,7 +5,11 @@
  */
 #include <YP/Provider.hpp>
 #include <iostream>
+#include <fstream>
 #include <vector>
+#include <thread>
+#include <algorithm>
+#include <nlohmann/json.hpp>
 #include <spdlog/spdlog.h>
 #include <tclap/CmdLine.h>
 
@@ -16,6 +20,9 @@ static unsigned    g_num_providers = 1;
 static int         g_num_threads = 0;
 static std::string g_log_level = "info";
 static bool        g_use_progress_thread = false;
+static int         g_num_xstreams = 0;
+static bool        g_pin_xstreams = false;
+static std::string g_manifest;
 
 static void parse_command_line(int argc, char** argv);
 
@@ -32,11 +39,58 @@ int main(int argc, char** argv) {
         }
     }
     )";
+    // Each provider gets its own pool and execution streams, unless
+    // g_num_xstreams is 0, in which case they share the handler pool.
+    // A negative g_num_xstreams splits the available cores evenly.
+    unsigned num_cores = std::max(1u, std::thread::hardware_concurrency());
+    unsigned num_xstreams = g_num_xstreams >= 0 ? g_num_xstreams
+                          : std::max(1u, num_cores / g_num_providers);
+    std::vector<tl::managed<tl::pool>>    pools;
+    std::vector<tl::managed<tl::xstream>> xstreams;
+    if(num_xstreams != 0) {
+        for(unsigned i=0 ; i < g_num_providers; i++) {
+            pools.push_back(tl::pool::create(tl::pool::access::mpmc));
+            for(unsigned j=0; j < num_xstreams; j++) {
+                xstreams.push_back(tl::xstream::create(tl::scheduler::predef::deflt, *pools.back()));
+                if(g_pin_xstreams) {
+                    int cpu = (i*num_xstreams + j) % num_cores;
+                    ABT_xstream_set_cpubind(xstreams.back()->native_handle(), cpu);
+                }
+            }
+        }
+    }
+    // Finalize callbacks run in reverse order, so this one runs after the
+    // providers below have been finalized: join the execution streams
+    // before their pools are freed, and while Argobots is still up.
+    engine.push_finalize_callback(&xstreams, [&xstreams, &pools]() {
+        xstreams.clear();
+        pools.clear();
+    });
     std::vector<YP::Provider> providers;
     for(unsigned i=0 ; i < g_num_providers; i++) {
-        providers.emplace_back(engine, i, provider_config);
+        tl::pool pool = pools.empty() ? tl::pool{} : *pools[i];
+        providers.emplace_back(engine, i, provider_config, pool);
+    }
+    std::string address = engine.self();
+    spdlog::info("Server running at address {}", address);
+    if(!g_manifest.empty()) {
+        auto manifest = nlohmann::json::object();
+        manifest["providers"] = nlohmann::json::array();
+        for(unsigned i=0 ; i < g_num_providers; i++) {
+            manifest["providers"].push_back({{"address", address}, {"provider_id", i}});
+        }
+        if(g_manifest == "-") {
+            std::cout << manifest.dump(4) << std::endl;
+        } else {
+            std::ofstream ofs(g_manifest);
+            ofs << manifest.dump(4) << std::endl;
+            if(ofs) {
+                spdlog::info("Connection manifest written to {}", g_manifest);
+            } else {
+                spdlog::error("Could not write connection manifest to {}", g_manifest);
+            }
+        }
     }
-    spdlog::info("Server running at address {}", (std::string)engine.self());
     engine.wait_for_finalize();
     return 0;
 }
@@ -48,17 +102,29 @@ void parse_command_line(int argc, char** argv) {
         TCLAP::ValueArg<unsigned>    providersArg("n", "num-providers", "Number of providers to spawn (default 1)", false, 1, "int");
         TCLAP::SwitchArg progressThreadArg("p","use-progress-thread","Use a Mercury progress thread", cmd, false);
         TCLAP::ValueArg<int> numThreads("t","num-threads", "Number of threads for RPC handlers", false, 0, "int");
+        TCLAP::ValueArg<int> numXstreams("x","xstreams-per-provider", "Number of execution streams dedicated to each provider (default 0: share the RPC handler pool, -1: split available cores)", false, 0, "int");
+        TCLAP::SwitchArg pinXstreamsArg("c","pin-xstreams","Pin each provider's execution streams to consecutive cores", cmd, false);
+        TCLAP::ValueArg<std::string> manifestArg("m","manifest", "File in which to write the providers' connection manifest (- for stdout)", false, "", "string");
         TCLAP::ValueArg<std::string> logLevel("v","verbose", "Log level (trace, debug, info, warning, error, critical, off)", false, "info", "string");
         cmd.add(addressArg);
         cmd.add(providersArg);
         cmd.add(numThreads);
+        cmd.add(numXstreams);
+        cmd.add(manifestArg);
         cmd.add(logLevel);
         cmd.parse(argc, argv);
         g_address = addressArg.getValue();
         g_num_providers = providersArg.getValue();
         g_num_threads = numThreads.getValue();
+        g_num_xstreams = numXstreams.getValue();
+        g_pin_xstreams = pinXstreamsArg.getValue();
+        g_manifest = manifestArg.getValue();
         g_use_progress_thread = progressThreadArg.getValue();
         g_log_level = logLevel.getValue();
+        if(g_num_providers == 0) {
+            std::cerr << "error: the number of providers must be at least 1" << std::endl;
+            exit(-1);
+        }
     } catch(TCLAP::ArgException &e) {
         std::cerr << "error: " << e.error() << " for arg " << e.argId() << std::endl;
         exit(-1);
@@ -9,6 +9,7 @@
 #include <YP/PhonebookHandle.hpp>
 #include <thallium.hpp>
 #include <memory>
+#include <vector>
 
 namespace YP {
 
@@ -89,6 +90,39 @@ class Client {
                                       uint16_t provider_id,
                                       bool check = true) const;
 
+    /**
+     * @brief Creates handles to all the phonebooks listed in a group
+     * file. The group file is a JSON document of the following form:
+     *
+     * { "providers": [ { "address": "na+sm://...", "provider_id": 0 }, ... ] }
+     *
+     * The addresses are looked up concurrently and no check RPC is sent.
+     * Addresses are cached by the Client, so calling openGroup again
+     * after the file has changed only looks up new addresses.
+     *
+     * @param filename Path to the group file.
+     *
+     * @return a vector of PhonebookHandle, in the order of the file.
+     */
+    std::vector<PhonebookHandle> openGroup(const std::string& filename) const;
+
+    /**
+     * @brief Enables tracing for a fraction of the requests sent by
+     * this client. Sampled requests carry a trace id that makes the
+     * provider record its own stages of the request as well.
+     *
+     * @param sample_rate Fraction of requests to trace (0 disables tracing).
+     */
+    void setTraceSampleRate(double sample_rate);
+
+    /**
+     * @brief Get the trace events recorded in this process, in the
+     * Chrome trace event JSON format (viewable in Perfetto).
+     *
+     * @return JSON-formatted string.
+     */
+    std::string getTraces() const;
+
     /**
      * @brief Checks that the Client instance is valid.
      */
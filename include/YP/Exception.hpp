@@ -6,14 +6,27 @@
 #ifndef __YP_EXCEPTION_HPP
 #define __YP_EXCEPTION_HPP
 
+#include <cstdint>
 #include <exception>
 #include <string>
 
 namespace YP {
 
+/**
+ * @brief Category of error carried by a failed Result
+ * or by the Exception it throws.
+ */
+enum class ErrorCode : uint8_t {
+    Generic,         // unspecified, see the error string
+    NoPhonebook,     // the provider has no phonebook attached
+    DeadlineExpired, // the request reached the provider past its deadline
+    Timeout          // no response arrived before the request's timeout
+};
+
 class Exception : public std::exception {
 
     std::string m_error;
+    ErrorCode   m_code = ErrorCode::Generic;
 
     public:
 
@@ -21,9 +34,21 @@ class Exception : public std::exception {
     Exception(Args&&... args)
     : m_error(std::forward<Args>(args)...) {}
 
+    template<typename ... Args>
+    Exception(ErrorCode code, Args&&... args)
+    : m_error(std::forward<Args>(args)...)
+    , m_code(code) {}
+
     virtual const char* what() const noexcept override {
         return m_error.c_str();
     }
+
+    /**
+     * @brief Returns the category of the error.
+     */
+    ErrorCode code() const noexcept {
+        return m_code;
+    }
 };
 
 }
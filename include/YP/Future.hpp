@@ -9,8 +9,12 @@
 #include <YP/Exception.hpp>
 #include <YP/Result.hpp>
 #include <thallium.hpp>
+#include <margo-timer.h>
 #include <memory>
+#include <mutex>
 #include <functional>
+#include <chrono>
+#include <optional>
 
 namespace YP {
 
@@ -23,6 +27,15 @@ class Future {
 
     public:
 
+    using time_point = std::chrono::steady_clock::time_point;
+
+    /**
+     * @brief Callback invoked once the response has been received by
+     * wait(), with the index of the request it came from, whether the
+     * request succeeded, and when the response arrived if that is known.
+     */
+    using CompletionCallback = std::function<void(size_t, bool, std::optional<time_point>)>;
+
     /**
      * @brief Copy constructor.
      */
@@ -54,29 +67,237 @@ class Future {
     ~Future() = default;
 
     /**
-     * @brief Wait for the request to complete.
+     * @brief Wait for the request to complete. If the request was
+     * sent with a timeout, this throws an Exception once the timeout
+     * has expired. Waiting again returns (or throws) the same outcome.
      */
     T wait() {
-        Result<Wrapper> result = m_resp.wait();
-        return std::move(result).valueOrThrow();
+        if(!m_result) {
+            if(m_cancelled) throw Exception{"Request was cancelled"};
+            m_result = waitForResult();
+        }
+        return m_result->valueOrThrow();
+    }
+
+    /**
+     * @brief Wait for the request to complete, throwing an Exception
+     * with ErrorCode::Timeout if it has not completed within the given
+     * timeout. The request is not affected, and the Future can be
+     * waited on again after a timeout.
+     *
+     * The response is then waited on by a ULT in the engine's handler
+     * pool, and the timeout is implemented with a margo timer.
+     *
+     * @param timeout Maximum time to wait.
+     */
+    T wait(std::chrono::duration<double, std::milli> timeout) {
+        if(!m_result) {
+            if(m_cancelled) throw Exception{"Request was cancelled"};
+            if(!waitFor(timeout))
+                throw Exception{ErrorCode::Timeout, "Timed out waiting for the request"};
+            m_result = waitForResult();
+        }
+        return m_result->valueOrThrow();
+    }
+
+    /**
+     * @brief Abandon the request. Its response will be ignored
+     * and any subsequent call to wait() will throw an Exception,
+     * unless the Future had already been waited on successfully.
+     * The request is not recalled from the provider, which will
+     * however drop it if its deadline has passed.
+     */
+    void cancel() {
+        m_cancelled = true;
+        m_on_completion = nullptr;
+        std::lock_guard<thallium::mutex> lock{m_state->m_mtx};
+        m_state->m_cancelled = true;
     }
 
     /**
      * @brief Test if the request has completed, without blocking.
+     * When it has, the time of the first call observing it is used as
+     * the arrival time of a response that no ULT was waiting on.
      */
     bool completed() const {
-        return m_resp.received();
+        if(m_result) return true;
+        std::lock_guard<thallium::mutex> lock{m_state->m_mtx};
+        if(m_state->m_result) return true;
+        bool received = m_state->m_resp.received()
+            || (m_state->m_hedge_resp && m_state->m_hedge_resp->received());
+        if(!received)
+            m_state->m_seen_pending = true;
+        else if(m_state->m_seen_pending && !m_state->m_arrival)
+            m_state->m_arrival = std::chrono::steady_clock::now();
+        return received;
     }
 
     /**
-     * @brief Constructor.
+     * @brief Constructor. on_completion is called once
+     * the response has been received by wait().
+     */
+    Future(thallium::engine engine,
+           thallium::async_response resp,
+           CompletionCallback on_completion = {})
+    : m_state(std::make_shared<State>(std::move(engine), std::move(resp)))
+    , m_on_completion(std::move(on_completion)) {}
+
+    /**
+     * @brief Constructor for a hedged request. If the response
+     * has not arrived by hedge_time, hedge is called to send the
+     * same request to another provider, and whichever response
+     * arrives first is used. on_completion is called with 0 if
+     * the response came from the original request, 1 if it came
+     * from the hedge.
+     *
+     * Both requests are waited on by ULTs in the engine's handler
+     * pool, the one sending the hedge sleeping on a margo timer until
+     * hedge_time, so that wait() returns as soon as a response arrives.
      */
-    Future(thallium::async_response resp)
-    : m_resp(std::move(resp)) {}
+    Future(thallium::engine engine,
+           thallium::async_response resp,
+           std::function<thallium::async_response()> hedge,
+           time_point hedge_time,
+           CompletionCallback on_completion = {})
+    : m_state(std::make_shared<State>(engine, std::move(resp)))
+    , m_on_completion(std::move(on_completion)) {
+        watch();
+        engine.get_handler_pool().make_thread([state=m_state, hedge=std::move(hedge), hedge_time]() {
+            std::chrono::duration<double, std::milli> delay =
+                hedge_time - std::chrono::steady_clock::now();
+            if(delay.count() > 0) thallium::thread::sleep(state->m_engine, delay.count());
+            {
+                std::lock_guard<thallium::mutex> lock{state->m_mtx};
+                if(state->m_result || state->m_cancelled) return;
+                state->m_hedge_resp.emplace(hedge());
+            }
+            // only this ULT accesses m_hedge_resp once it is set
+            state->publish(receive(*state->m_hedge_resp), 1);
+        }, thallium::anonymous{});
+    }
 
     private:
 
-    thallium::async_response m_resp;
+    /**
+     * @brief State shared with the ULTs waiting on the responses.
+     */
+    struct State {
+
+        thallium::engine                        m_engine;
+        thallium::mutex                         m_mtx;
+        thallium::condition_variable            m_cv;
+        thallium::async_response                m_resp;
+        std::optional<thallium::async_response> m_hedge_resp;
+        std::optional<Result<Wrapper>>          m_result;
+        size_t                                  m_index = 0;
+        std::optional<time_point>               m_arrival;
+        bool                                    m_cancelled = false;
+        bool                                    m_watched = false; // m_resp is waited on by a ULT
+        bool                                    m_seen_pending = false; // completed() returned false
+
+        State(thallium::engine engine, thallium::async_response resp)
+        : m_engine(std::move(engine))
+        , m_resp(std::move(resp)) {}
+
+        // Keeps the first result published and wakes up wait().
+        void publish(Result<Wrapper>&& result, size_t index) {
+            std::lock_guard<thallium::mutex> lock{m_mtx};
+            if(m_result) return;
+            m_result  = std::move(result);
+            m_index   = index;
+            m_arrival = std::chrono::steady_clock::now();
+            m_cv.notify_all();
+        }
+    };
+
+    static Result<Wrapper> receive(thallium::async_response& resp) {
+        Result<Wrapper> result;
+        try {
+            result = resp.wait().template as<Result<Wrapper>>();
+        } catch(const thallium::timeout&) {
+            result.success() = false;
+            result.code()    = ErrorCode::Timeout;
+            result.error()   = "Request timed out";
+        } catch(const std::exception& ex) {
+            result.success() = false;
+            result.error()   = ex.what();
+        }
+        return result;
+    }
+
+    // Starts a ULT waiting on the original response, after which
+    // wait() no longer waits on the response itself.
+    void watch() {
+        if(m_state->m_watched) return;
+        m_state->m_watched = true;
+        m_state->m_engine.get_handler_pool().make_thread([state=m_state]() {
+            state->publish(receive(state->m_resp), 0);
+        }, thallium::anonymous{});
+    }
+
+    // Waits until a result has been published or the timeout has expired,
+    // returning whether a result is available. The timeout is handled by
+    // a margo timer whose callback wakes up the waiter. Cancelling the
+    // timer waits for its callback if it is running, so expiry can live
+    // on the stack.
+    bool waitFor(std::chrono::duration<double, std::milli> timeout) {
+        watch();
+        struct Expiry {
+            State* state;
+            bool   expired = false;
+        } expiry{m_state.get()};
+        auto on_expiry = [](void* arg) {
+            auto e = static_cast<Expiry*>(arg);
+            std::lock_guard<thallium::mutex> lock{e->state->m_mtx};
+            e->expired = true;
+            e->state->m_cv.notify_all();
+        };
+        margo_timer_t timer;
+        if(margo_timer_create(m_state->m_engine.get_margo_instance(), on_expiry, &expiry, &timer) != HG_SUCCESS)
+            throw Exception{"Could not create margo timer"};
+        margo_timer_start(timer, timeout.count());
+        {
+            std::unique_lock<thallium::mutex> lock{m_state->m_mtx};
+            while(!m_state->m_result && !expiry.expired) m_state->m_cv.wait(lock);
+        }
+        margo_timer_cancel(timer);
+        margo_timer_destroy(timer);
+        std::lock_guard<thallium::mutex> lock{m_state->m_mtx};
+        return static_cast<bool>(m_state->m_result);
+    }
+
+    // The arrival time passed to m_on_completion is only known if the
+    // response was received while something was waiting or polling for
+    // it; a response that had already arrived when wait() was first
+    // called is reported without one.
+    Result<Wrapper> waitForResult() {
+        if(!m_state->m_watched) {
+            bool pending = !m_state->m_resp.received();
+            auto result  = receive(m_state->m_resp);
+            std::optional<time_point> arrival;
+            if(pending) {
+                arrival = std::chrono::steady_clock::now();
+            } else {
+                std::lock_guard<thallium::mutex> lock{m_state->m_mtx};
+                arrival = m_state->m_arrival;
+            }
+            if(m_on_completion) m_on_completion(0, result.success(), arrival);
+            return result;
+        }
+        std::unique_lock<thallium::mutex> lock{m_state->m_mtx};
+        while(!m_state->m_result) m_state->m_cv.wait(lock);
+        auto result  = *m_state->m_result;
+        auto index   = m_state->m_index;
+        auto arrival = m_state->m_arrival;
+        lock.unlock();
+        if(m_on_completion) m_on_completion(index, result.success(), arrival);
+        return result;
+    }
+
+    std::shared_ptr<State>         m_state;
+    CompletionCallback             m_on_completion;
+    std::optional<Result<Wrapper>> m_result;
+    bool                           m_cancelled = false;
 };
 
 }
@@ -8,7 +8,9 @@
 
 #include <thallium.hpp>
 #include <memory>
+#include <chrono>
 #include <unordered_set>
+#include <vector>
 #include <nlohmann/json.hpp>
 #include <YP/Client.hpp>
 #include <YP/Exception.hpp>
@@ -70,18 +72,62 @@ class PhonebookHandle {
      */
     operator bool() const;
 
+    /**
+     * @brief Sets the phonebooks able to serve the same read requests
+     * as this one. Read operations are then sent to whichever of this
+     * phonebook and its replicas has the lowest observed latency times
+     * outstanding requests, among two picked at random. Error responses
+     * count as slow ones, so that a failing replica is avoided.
+     * Passing an empty vector disables load balancing.
+     * This setting is shared by all the copies of this PhonebookHandle.
+     *
+     * @param replicas PhonebookHandles of the replicas.
+     */
+    void setReplicas(const std::vector<PhonebookHandle>& replicas);
+
+    /**
+     * @brief Enables hedged requests for read operations: if the target
+     * phonebook has not answered after the given delay, the request is
+     * also sent to the replica and the first response is used.
+     * Passing an invalid PhonebookHandle disables hedging.
+     * This setting is shared by all the copies of this PhonebookHandle.
+     *
+     * @param replica PhonebookHandle of a phonebook able to serve
+     * the same requests.
+     * @param delay Delay after which a request is hedged.
+     */
+    void setHedging(const PhonebookHandle& replica,
+                    std::chrono::duration<double, std::milli> delay);
+
     /**
      * @brief Requests the target phonebook to compute the sum of two numbers.
      * If result is null, it will be ignored. If req is not null, this call
      * will be non-blocking and the caller is responsible for waiting on
      * the request.
      *
+     * If a non-zero timeout is given, the request carries a deadline
+     * and the provider will not execute it past that deadline. The
+     * deadline relies on the clocks of client and provider being in sync.
+     * The request is also cancelled on the client side if no response
+     * has arrived when the timeout expires, in which case waiting on
+     * the Future throws an Exception.
+     *
      * @param[in] x first integer
      * @param[in] y second integer
+     * @param[in] timeout time after which the request is abandoned
      *
      * @return a Future<int32_t> that can be awaited to get the result.
      */
-    Future<int32_t> computeSum(int32_t x, int32_t y) const;
+    Future<int32_t> computeSum(int32_t x, int32_t y,
+                               std::chrono::duration<double, std::milli> timeout = {}) const;
+
+    /**
+     * @brief Requests the allocation statistics of the target provider,
+     * as returned by Provider::getAllocationStats().
+     *
+     * @return JSON-formatted string.
+     */
+    std::string getAllocationStats() const;
 
     private:
 
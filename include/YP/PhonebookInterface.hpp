@@ -32,6 +32,11 @@ namespace YP {
  *
  * std::unique_ptr<PhonebookInterface> create(const json& config)
  * std::unique_ptr<PhonebookInterface> attach(const json& config)
+ *
+ * Backends may also be built into their own shared library. Naming
+ * this library in the "library" field of the provider's "phonebook"
+ * configuration will make the provider dlopen it before looking up
+ * the backend type, which runs its YP_REGISTER_BACKEND.
  */
 class PhonebookInterface {
 
@@ -68,6 +68,44 @@ class Provider {
      */
     std::string getConfig() const;
 
+    /**
+     * @brief Get the trace events recorded in this process, in the
+     * Chrome trace event JSON format (viewable in Perfetto).
+     * Requests are traced when the client sending them samples them.
+     *
+     * @return JSON-formatted string.
+     */
+    std::string getTraces() const;
+
+    /**
+     * @brief Return the number of allocations and bytes allocated
+     * while handling each type of RPC, as a JSON-formatted string
+     * of the form {"enabled": bool, "hooked": bool, "rpcs": {name:
+     * {"count": N, "bytes": N}}}. Counting requires YP to be built
+     * with ENABLE_ALLOC_PROFILING, "profile_allocations": true in the
+     * provider's configuration ("enabled"), and YP's operator new to
+     * be in effect ("hooked"). It is not when the executable dlopens
+     * YP without being linked against it, unless libYP-alloc-hook.so
+     * is LD_PRELOADed. Clients can also get these statistics with
+     * PhonebookHandle::getAllocationStats().
+     *
+     * @return JSON formatted string.
+     */
+    std::string getAllocationStats() const;
+
+    /**
+     * @brief Change the Argobots pool used to handle RPCs.
+     * The RPCs have to be registered again, and requests arriving
+     * in the short interval during which they are not fail.
+     * This function returns once the handlers queued or running in
+     * the old pool have completed, so the old pool may then be
+     * destroyed. It assumes the old pool is FIFO and is being
+     * executed by at least one execution stream.
+     *
+     * @param pool New pool (the default pool is used if null).
+     */
+    void changePool(const tl::pool& pool);
+
     /**
      * @brief Checks whether the Provider instance is valid.
      */
@@ -8,18 +8,73 @@
 
 #include <thallium/serialization/stl/string.hpp>
 #include <YP/Exception.hpp>
+#include <cstdint>
+#include <memory>
 #include <string>
+#include <type_traits>
 
 namespace YP {
 
+/**
+ * @brief Serialization function for Thallium.
+ */
+template<typename Archive>
+void serialize(Archive& a, ErrorCode& code) {
+    a & reinterpret_cast<std::underlying_type_t<ErrorCode>&>(code);
+}
+
+namespace detail {
+
+/**
+ * @brief String that is only allocated when it is first accessed
+ * for writing, so that successful Results do not carry one.
+ */
+class LazyString {
+
+    public:
+
+    LazyString() = default;
+    LazyString(LazyString&&) = default;
+    LazyString& operator=(LazyString&&) = default;
+
+    LazyString(const LazyString& other)
+    : m_str(other.m_str ? std::make_unique<std::string>(*other.m_str) : nullptr) {}
+
+    LazyString& operator=(const LazyString& other) {
+        if(this == &other) return *this;
+        m_str = other.m_str ? std::make_unique<std::string>(*other.m_str) : nullptr;
+        return *this;
+    }
+
+    std::string& get() {
+        if(!m_str) m_str = std::make_unique<std::string>();
+        return *m_str;
+    }
+
+    const std::string& get() const {
+        static const std::string empty;
+        return m_str ? *m_str : empty;
+    }
+
+    private:
+
+    std::unique_ptr<std::string> m_str;
+};
+
+}
+
 /**
  * @brief The Result object is a generic object
  * used to hold and send back the result of an RPC.
- * It contains three fields:
+ * It contains four fields:
  * - success must be set to true if the request succeeded, false otherwise
  * - error must be set to an error string if an error occured
+ * - code may be set to an ErrorCode if an error occured
  * - value must be set to the result of the request if it succeeded
  *
+ * The error string is only allocated when an error is set, and the
+ * error fields are only serialized when success is false.
+ *
  * This class is specialized for two types: bool and std::string.
  * If bool is used, both the value and the success fields will be
  * managed by the same underlying variable. If std::string is used,
@@ -41,12 +96,14 @@ class Result {
     template<typename U>
     Result(Result<U>&& other)
     : m_success{other.m_success}
+    , m_code{other.m_code}
     , m_error{std::move(other.m_error)}
     , m_value{std::move(other.m_value)} {}
 
     template<typename U>
     Result(const Result<U>& other)
     : m_success{other.m_success}
+    , m_code{other.m_code}
     , m_error{other.m_error}
     , m_value{other.m_value} {}
 
@@ -54,6 +111,7 @@ class Result {
     Result& operator=(Result<U>&& other) {
         if(this == reinterpret_cast<decltype(this)>(&other)) return *this;
         m_success = other.m_success;
+        m_code    = other.m_code;
         m_error   = std::move(other.m_error);
         m_value   = std::move(other.m_value);
         return *this;
@@ -63,6 +121,7 @@ class Result {
     Result& operator=(const Result<U>& other) {
         if(this == reinterpret_cast<decltype(this)>(&other)) return *this;
         m_success = other.m_success;
+        m_code    = other.m_code;
         m_error   = other.m_error;
         m_value   = other.m_value;
         return *this;
@@ -86,14 +145,28 @@ class Result {
      * @brief Error string if the request failed.
      */
     std::string& error() {
-        return m_error;
+        return m_error.get();
     }
 
     /**
      * @brief Error string if the request failed.
      */
     const std::string& error() const {
-        return m_error;
+        return m_error.get();
+    }
+
+    /**
+     * @brief Error code if the request failed.
+     */
+    ErrorCode& code() {
+        return m_code;
+    }
+
+    /**
+     * @brief Error code if the request failed.
+     */
+    const ErrorCode& code() const {
+        return m_code;
     }
 
     /**
@@ -154,7 +227,7 @@ class Result {
      */
     void check() const {
         if(!m_success)
-            throw Exception(m_error);
+            throw Exception(m_code, m_error.get());
     }
 
     /**
@@ -169,15 +242,17 @@ class Result {
         if(m_success) {
             a & m_value;
         } else {
-            a & m_error;
+            a & m_code;
+            a & m_error.get();
         }
     }
 
     private:
 
-    bool        m_success = true;
-    std::string m_error   = "";
-    T           m_value;
+    bool               m_success = true;
+    ErrorCode          m_code    = ErrorCode::Generic;
+    detail::LazyString m_error;
+    T                  m_value;
 };
 
 template<>
@@ -207,6 +282,14 @@ class Result<std::string> {
         return m_content;
     }
 
+    ErrorCode& code() {
+        return m_code;
+    }
+
+    const ErrorCode& code() const {
+        return m_code;
+    }
+
     std::string& value() {
         return m_content;
     }
@@ -237,18 +320,21 @@ class Result<std::string> {
 
     void check() const {
         if(!m_success)
-            throw Exception(m_content);
+            throw Exception(m_code, m_content);
     }
 
     template<typename Archive>
     void serialize(Archive& a) {
         a & m_success;
+        if(!m_success)
+            a & m_code;
         a & m_content;
     }
 
     private:
 
     bool        m_success = true;
+    ErrorCode   m_code    = ErrorCode::Generic;
     std::string m_content = "";
 };
 
@@ -272,11 +358,19 @@ class Result<bool> {
     }
 
     std::string& error() {
-        return m_error;
+        return m_error.get();
     }
 
     const std::string& error() const {
-        return m_error;
+        return m_error.get();
+    }
+
+    ErrorCode& code() {
+        return m_code;
+    }
+
+    const ErrorCode& code() const {
+        return m_code;
     }
 
     bool& value() {
@@ -300,20 +394,23 @@ class Result<bool> {
 
     void check() const {
         if(!m_success)
-            throw Exception(m_error);
+            throw Exception(m_code, m_error.get());
     }
 
     template<typename Archive>
     void serialize(Archive& a) {
         a & m_success;
-        if(!m_success)
-            a & m_error;
+        if(!m_success) {
+            a & m_code;
+            a & m_error.get();
+        }
     }
 
     private:
 
-    bool        m_success = true;
-    std::string m_error   = "";
+    bool               m_success = true;
+    ErrorCode          m_code    = ErrorCode::Generic;
+    detail::LazyString m_error;
 };
 
 }
@@ -0,0 +1,51 @@
+/*
+ * (C) 2024 The University of Chicago
+ *
+ * See COPYRIGHT in top-level directory.
+ */
+#include "AllocProfiler.hpp"
+
+#include <cstdlib>
+#include <new>
+
+#ifdef YP_ENABLE_ALLOC_PROFILING
+
+namespace YP {
+
+std::atomic<ABT_key>& AllocProfiler::key() {
+    static std::atomic<ABT_key> k{ABT_KEY_NULL};
+    return k;
+}
+
+bool& AllocProfiler::probing() {
+    static thread_local bool p = false;
+    return p;
+}
+
+void AllocProfiler::onAllocation(size_t size) {
+    auto& p = probing();
+    if(p) p = false;
+    if(auto counters = current(key().load(std::memory_order_acquire))) {
+        counters->count.fetch_add(1, std::memory_order_relaxed);
+        counters->bytes.fetch_add(size, std::memory_order_relaxed);
+    }
+}
+
+}
+
+void* operator new(std::size_t size) {
+    YP::AllocProfiler::onAllocation(size);
+    void* p = std::malloc(size ? size : 1);
+    if(!p) throw std::bad_alloc{};
+    return p;
+}
+
+void operator delete(void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept {
+    std::free(p);
+}
+
+#endif
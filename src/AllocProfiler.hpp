@@ -0,0 +1,136 @@
+/*
+ * (C) 2024 The University of Chicago
+ *
+ * See COPYRIGHT in top-level directory.
+ */
+#ifndef __YP_ALLOC_PROFILER_H
+#define __YP_ALLOC_PROFILER_H
+
+#include "config.h"
+
+#include <abt.h>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace YP {
+
+/**
+ * @brief Number of allocations and bytes allocated
+ * while handling a given type of RPC.
+ */
+struct AllocCounters {
+    std::atomic<uint64_t> count{0};
+    std::atomic<uint64_t> bytes{0};
+};
+
+/**
+ * @brief When YP is built with ENABLE_ALLOC_PROFILING, the global
+ * operator new is replaced (see AllocProfiler.cpp) and every allocation
+ * made by a ULT while an AllocProfiler::Scope is alive is counted in
+ * that Scope's AllocCounters. The current Scope is stored in an Argobots
+ * ULT-local key, so it follows the ULT if it migrates to another
+ * execution stream, and allocations made by other ULTs in the meantime
+ * are not counted. Allocations made outside of a ULT are never counted.
+ */
+class AllocProfiler {
+
+    public:
+
+    class Scope {
+
+        public:
+
+#ifdef YP_ENABLE_ALLOC_PROFILING
+        Scope(AllocCounters* counters)
+        : m_key(createKey())
+        , m_previous(current(m_key)) {
+            if(m_key != ABT_KEY_NULL) ABT_key_set(m_key, counters);
+        }
+
+        ~Scope() {
+            if(m_key != ABT_KEY_NULL) ABT_key_set(m_key, m_previous);
+        }
+
+        private:
+
+        ABT_key        m_key;
+        AllocCounters* m_previous;
+#else
+        Scope(AllocCounters*) {}
+#endif
+
+        public:
+
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+    };
+
+    /**
+     * @brief Called by the replaced operator new.
+     */
+    static void onAllocation(size_t size);
+
+    /**
+     * @brief Whether the replaced operator new is the one in effect.
+     * The dynamic linker binds operator new to the first library in
+     * the global scope defining it. That is libstdc++ rather than
+     * YP-server when an executable that was not linked against YP
+     * dlopens it (e.g. Bedrock loading the module), unless
+     * libYP-alloc-hook.so, built from the same source, is LD_PRELOADed.
+     */
+    static bool hooked() {
+#ifdef YP_ENABLE_ALLOC_PROFILING
+        static const bool active = []() {
+            probing() = true;
+            void* volatile p = ::operator new(1);
+            ::operator delete(p);
+            bool missed = probing();
+            probing() = false;
+            return !missed;
+        }();
+        return active;
+#else
+        return false;
+#endif
+    }
+
+    static constexpr bool available() {
+#ifdef YP_ENABLE_ALLOC_PROFILING
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    private:
+
+    // Defined in AllocProfiler.cpp, so that a preloaded YP-alloc-hook
+    // interposes on them along with operator new.
+    // Set once by the first Scope, read by every allocation.
+    static std::atomic<ABT_key>& key();
+    // Set by hooked() and cleared by onAllocation().
+    static bool& probing();
+
+    static ABT_key createKey() {
+        static ABT_key k = []() {
+            ABT_key new_key;
+            if(ABT_key_create(nullptr, &new_key) != ABT_SUCCESS) return ABT_KEY_NULL;
+            key().store(new_key, std::memory_order_release);
+            return new_key;
+        }();
+        return k;
+    }
+
+    // Returns null when called outside of a ULT (ABT_key_get fails).
+    static AllocCounters* current(ABT_key k) {
+        void* counters = nullptr;
+        if(k == ABT_KEY_NULL || ABT_key_get(k, &counters) != ABT_SUCCESS) return nullptr;
+        return static_cast<AllocCounters*>(counters);
+    }
+};
+
+}
+
+#endif
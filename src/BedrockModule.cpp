@@ -4,6 +4,7 @@
  * See COPYRIGHT in top-level directory.
  */
 #include "YP/Client.hpp"
+#include "YP/Exception.hpp"
 #include "YP/Provider.hpp"
 #include "YP/ProviderHandle.hpp"
 
@@ -32,6 +33,18 @@ class YpComponent : public bedrock::AbstractComponent {
         return m_provider->getConfig();
     }
 
+    void changeDependency(
+            const std::string& dep_name,
+            const std::vector<std::shared_ptr<bedrock::NamedDependency>>& resolved_dependency) override {
+        if(dep_name != "pool")
+            throw YP::Exception{"YP component has no dependency named " + dep_name};
+        tl::pool pool;
+        if(!resolved_dependency.empty()) {
+            pool = resolved_dependency[0]->getHandle<tl::pool>();
+        }
+        m_provider->changePool(pool);
+    }
+
     static std::shared_ptr<bedrock::AbstractComponent>
         Register(const bedrock::ComponentArgs& args) {
             tl::pool pool;
@@ -52,7 +65,7 @@ class YpComponent : public bedrock::AbstractComponent {
                     /* type */ "pool",
                     /* is_required */ false,
                     /* is_array */ false,
-                    /* is_updatable */ false
+                    /* is_updatable */ true
                 }
             };
             return dependencies;
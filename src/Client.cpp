@@ -10,8 +10,15 @@
 
 #include "ClientImpl.hpp"
 #include "PhonebookHandleImpl.hpp"
+#include "Tracing.hpp"
 
 #include <thallium/serialization/stl/string.hpp>
+#include <nlohmann/json.hpp>
+
+#include <algorithm>
+#include <fstream>
+#include <limits>
+#include <mutex>
 
 namespace tl = thallium;
 
@@ -62,7 +69,80 @@ PhonebookHandle Client::makePhonebookHandle(
             throw Exception{ex.what()};
         }
     }
-    return std::make_shared<PhonebookHandleImpl>(self, std::move(ph));
+    return std::make_shared<PhonebookHandleImpl>(
+        self, std::move(ph), self->getStats(address, provider_id));
+}
+
+std::vector<PhonebookHandle> Client::openGroup(const std::string& filename) const {
+    using json = nlohmann::json;
+    std::ifstream file(filename);
+    if(!file) throw Exception{"Could not open group file " + filename};
+    json group;
+    try {
+        group = json::parse(file);
+    } catch(const json::exception& ex) {
+        throw Exception{"Could not parse group file " + filename + ": " + ex.what()};
+    }
+    if(!group.is_object() || !group.contains("providers") || !group["providers"].is_array())
+        throw Exception{"Group file " + filename + " should contain a \"providers\" array"};
+    auto& members = group["providers"];
+
+    std::vector<std::pair<std::string, uint16_t>> providers;
+    std::vector<std::string> addresses;
+    {
+        std::lock_guard<tl::mutex> lock{self->m_endpoints_mtx};
+        for(auto& member : members) {
+            if(!member.is_object()
+            || !member.contains("address") || !member["address"].is_string()
+            || !member.contains("provider_id") || !member["provider_id"].is_number_unsigned()
+            || member["provider_id"].get<uint64_t>() > std::numeric_limits<uint16_t>::max())
+                throw Exception{"Invalid provider entry in group file " + filename};
+            auto& address = member["address"].get_ref<const std::string&>();
+            providers.emplace_back(address, member["provider_id"].get<uint16_t>());
+            if(!self->m_endpoints.count(address)
+            && std::find(addresses.begin(), addresses.end(), address) == addresses.end())
+                addresses.push_back(address);
+        }
+    }
+
+    // look up new addresses concurrently
+    std::vector<tl::endpoint> endpoints(addresses.size());
+    std::vector<std::string>  errors(addresses.size());
+    std::vector<tl::managed<tl::thread>> ults;
+    for(size_t i = 0; i < addresses.size(); i++) {
+        ults.push_back(tl::xstream::self().make_thread([this, &addresses, &endpoints, &errors, i]() {
+            try {
+                endpoints[i] = self->m_engine.lookup(addresses[i]);
+            } catch(const std::exception& ex) {
+                errors[i] = ex.what();
+            }
+        }));
+    }
+    for(auto& ult : ults) ult->join();
+    for(size_t i = 0; i < addresses.size(); i++) {
+        if(!errors[i].empty())
+            throw Exception{"Could not lookup address " + addresses[i] + ": " + errors[i]};
+    }
+
+    std::vector<PhonebookHandle> handles;
+    handles.reserve(providers.size());
+    std::lock_guard<tl::mutex> lock{self->m_endpoints_mtx};
+    for(size_t i = 0; i < addresses.size(); i++)
+        self->m_endpoints.emplace(addresses[i], std::move(endpoints[i]));
+    for(auto& [address, provider_id] : providers) {
+        auto ph = tl::provider_handle(self->m_endpoints[address], provider_id);
+        handles.push_back(std::make_shared<PhonebookHandleImpl>(
+            self, std::move(ph), self->getStats(address, provider_id)));
+    }
+    return handles;
+}
+
+void Client::setTraceSampleRate(double sample_rate) {
+    self->m_trace_sample_rate = sample_rate;
+}
+
+std::string Client::getTraces() const {
+    return Tracer::dump("YP client " + static_cast<std::string>(self->m_engine.self()));
 }
 
 std::string Client::getConfig() const {
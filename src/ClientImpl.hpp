@@ -10,27 +10,94 @@
 #include <thallium/serialization/stl/unordered_set.hpp>
 #include <thallium/serialization/stl/unordered_map.hpp>
 #include <thallium/serialization/stl/string.hpp>
+#include <mutex>
+
+#include <atomic>
+#include <memory>
+#include <optional>
+#include <algorithm>
 
 namespace YP {
 
 namespace tl = thallium;
 
+/**
+ * @brief Statistics kept by a client about a provider,
+ * used to balance requests across replicas.
+ */
+struct ProviderStats {
+
+    std::atomic<uint64_t> m_outstanding{0};
+    std::atomic<double>   m_latency_us{0.0}; // moving average
+
+    void onRequestSent() {
+        m_outstanding++;
+    }
+
+    void onRequestAbandoned() {
+        m_outstanding--;
+    }
+
+    /**
+     * @brief Records a response. Its latency is not known if the response
+     * arrived before anyone waited on it. An error response counts as a
+     * sample of at least twice the current average and at least
+     * s_error_latency_us, so that a replica failing fast is avoided
+     * rather than preferred.
+     */
+    void onResponseReceived(std::optional<double> latency_us, bool success) {
+        m_outstanding--;
+        if(success && !latency_us) return;
+        // races between concurrent updates only lose a sample
+        double avg    = m_latency_us.load(std::memory_order_relaxed);
+        double sample = latency_us.value_or(0.0);
+        if(!success) sample = std::max({sample, 2*avg, s_error_latency_us});
+        avg = avg == 0.0 ? sample : avg + 0.2*(sample - avg);
+        m_latency_us.store(avg, std::memory_order_relaxed);
+    }
+
+    static constexpr double s_error_latency_us = 1000.0;
+
+    double load() const {
+        // +1 so that outstanding requests count before any latency is known
+        return (m_latency_us.load(std::memory_order_relaxed) + 1.0)
+             * (m_outstanding.load(std::memory_order_relaxed) + 1);
+    }
+};
+
 class ClientImpl {
 
     public:
 
     tl::engine           m_engine;
     tl::remote_procedure m_compute_sum;
+    tl::remote_procedure m_get_alloc_stats;
+
+    std::unordered_map<std::string, tl::endpoint> m_endpoints;
+    tl::mutex                                     m_endpoints_mtx;
+
+    std::atomic<double> m_trace_sample_rate{0.0};
+
+    std::unordered_map<std::string, std::shared_ptr<ProviderStats>> m_stats;
+    tl::mutex                                                       m_stats_mtx;
 
     ClientImpl(const tl::engine& engine)
     : m_engine(engine)
     , m_compute_sum(m_engine.define("YP_compute_sum"))
+    , m_get_alloc_stats(m_engine.define("YP_get_alloc_stats"))
     {}
 
     ClientImpl(margo_instance_id mid)
     : ClientImpl(tl::engine(mid)) {}
 
     ~ClientImpl() {}
+
+    std::shared_ptr<ProviderStats> getStats(const std::string& address, uint16_t provider_id) {
+        std::lock_guard<tl::mutex> lock{m_stats_mtx};
+        auto& stats = m_stats[address + "/" + std::to_string(provider_id)];
+        if(!stats) stats = std::make_shared<ProviderStats>();
+        return stats;
+    }
 };
 
 }
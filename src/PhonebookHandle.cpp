@@ -9,12 +9,52 @@
 
 #include "ClientImpl.hpp"
 #include "PhonebookHandleImpl.hpp"
+#include "Tracing.hpp"
 
 #include <thallium/serialization/stl/string.hpp>
 #include <thallium/serialization/stl/pair.hpp>
 
 namespace YP {
 
+namespace {
+
+/**
+ * @brief Tracks a request sent to a provider for its ProviderStats,
+ * including when the corresponding Future is never waited on.
+ */
+struct PendingRequest {
+
+    std::shared_ptr<ProviderStats>        m_stats;
+    std::chrono::steady_clock::time_point m_start = std::chrono::steady_clock::now();
+    bool                                  m_completed = false;
+    TraceEvent                            m_trace;
+
+    PendingRequest(std::shared_ptr<ProviderStats> stats, uint64_t trace_id, const char* name)
+    : m_stats(std::move(stats))
+    , m_trace{trace_id, name, trace_id ? Tracer::now() : 0, 0} {
+        m_stats->onRequestSent();
+    }
+
+    ~PendingRequest() {
+        if(!m_completed) m_stats->onRequestAbandoned();
+    }
+
+    void complete(bool success, std::optional<std::chrono::steady_clock::time_point> arrival) {
+        if(m_completed) return;
+        m_completed = true;
+        std::optional<double> latency_us;
+        if(arrival)
+            latency_us = std::chrono::duration<double, std::micro>(*arrival - m_start).count();
+        m_stats->onResponseReceived(latency_us, success);
+        if(m_trace.trace_id) {
+            m_trace.end_us = Tracer::now();
+            Tracer::record(m_trace);
+        }
+    }
+};
+
+}
+
 PhonebookHandle::PhonebookHandle() = default;
 
 PhonebookHandle::PhonebookHandle(const std::shared_ptr<PhonebookHandleImpl>& impl)
@@ -38,14 +78,92 @@ Client PhonebookHandle::client() const {
     return Client(self->m_client);
 }
 
+void PhonebookHandle::setReplicas(const std::vector<PhonebookHandle>& replicas)
+{
+    if(not self) throw Exception("Invalid YP::PhonebookHandle object");
+    // replicas are referenced by provider handle and stats rather than
+    // by PhonebookHandleImpl, so handles listing each other do not leak
+    std::vector<Target> targets{Target{self->m_ph, self->m_stats}};
+    for(auto& replica : replicas) {
+        if(not replica) throw Exception("Invalid YP::PhonebookHandle object");
+        targets.push_back(Target{replica.self->m_ph, replica.self->m_stats});
+    }
+    self->updateRouting([&targets](Routing& routing) {
+        routing.m_targets = std::move(targets);
+    });
+}
+
+void PhonebookHandle::setHedging(
+        const PhonebookHandle& replica,
+        std::chrono::duration<double, std::milli> delay)
+{
+    if(not self) throw Exception("Invalid YP::PhonebookHandle object");
+    self->updateRouting([&replica, delay](Routing& routing) {
+        routing.m_hedge        = static_cast<bool>(replica);
+        routing.m_hedge_target = replica ? Target{replica.self->m_ph, replica.self->m_stats} : Target{};
+        routing.m_hedge_delay  = delay;
+    });
+}
+
 Future<int32_t> PhonebookHandle::computeSum(
-        int32_t x, int32_t y) const
+        int32_t x, int32_t y,
+        std::chrono::duration<double, std::milli> timeout) const
+{
+    if(not self) throw Exception("Invalid YP::PhonebookHandle object");
+    uint64_t deadline_us = 0;
+    if(timeout.count() != 0) {
+        auto deadline = std::chrono::system_clock::now().time_since_epoch() + timeout;
+        deadline_us = std::chrono::duration_cast<std::chrono::microseconds>(deadline).count();
+    }
+    auto  routing  = self->routing();
+    auto& target   = PhonebookHandleImpl::pickReplica(*routing);
+    auto& ph       = target.m_ph;
+    auto  trace_id = Tracer::sample(self->m_client->m_trace_sample_rate);
+    auto  pending  = std::make_shared<PendingRequest>(target.m_stats, trace_id, "YP_compute_sum:client");
+    // requests with a deadline are also sent with a timeout, so that
+    // Mercury cancels them if no response has arrived by then
+    auto expiry = pending->m_start
+        + std::chrono::duration_cast<std::chrono::steady_clock::duration>(timeout);
+    auto send = [client=self->m_client, deadline_us, expiry, x, y, trace_id](const tl::provider_handle& ph) {
+        if(deadline_us == 0 || expiry <= std::chrono::steady_clock::now())
+            return client->m_compute_sum.on(ph).async(x, y, deadline_us, trace_id);
+        std::chrono::duration<double, std::milli> remaining = expiry - std::chrono::steady_clock::now();
+        return client->m_compute_sum.on(ph).timed_async(remaining, x, y, deadline_us, trace_id);
+    };
+    auto async_response = [&]() {
+        TraceSpan forward_span{trace_id, "YP_compute_sum:forward"};
+        return send(ph);
+    }();
+    auto hedge_time = pending->m_start
+        + std::chrono::duration_cast<std::chrono::steady_clock::duration>(routing->m_hedge_delay);
+    auto hedge_target = PhonebookHandleImpl::pickHedgeTarget(*routing, target);
+    if(hedge_target && (deadline_us == 0 || hedge_time < expiry)) {
+        // the hedge is accounted for on the stats of the replica it is sent to
+        auto pending_hedge = std::make_shared<std::shared_ptr<PendingRequest>>();
+        auto hedge = [send, routing, &hedge_target=*hedge_target, pending_hedge, trace_id]() {
+            *pending_hedge = std::make_shared<PendingRequest>(
+                hedge_target.m_stats, trace_id, "YP_compute_sum:client");
+            TraceSpan forward_span{trace_id, "YP_compute_sum:hedge"};
+            return send(hedge_target.m_ph);
+        };
+        auto on_completion = [pending, pending_hedge](size_t index, bool success, auto arrival) {
+            if(index == 0) pending->complete(success, arrival);
+            else (*pending_hedge)->complete(success, arrival);
+        };
+        return Future<int32_t>{self->m_client->m_engine, std::move(async_response),
+                               std::move(hedge), hedge_time, std::move(on_completion)};
+    }
+    auto on_completion = [pending](size_t, bool success, auto arrival) {
+        pending->complete(success, arrival);
+    };
+    return Future<int32_t>{self->m_client->m_engine, std::move(async_response), std::move(on_completion)};
+}
+
+std::string PhonebookHandle::getAllocationStats() const
 {
     if(not self) throw Exception("Invalid YP::PhonebookHandle object");
-    auto& rpc = self->m_client->m_compute_sum;
-    auto& ph  = self->m_ph;
-    auto async_response = rpc.on(ph).async(x, y);
-    return Future<int32_t>{std::move(async_response)};
+    Result<std::string> result = self->m_client->m_get_alloc_stats.on(self->m_ph)();
+    return std::move(result).valueOrThrow();
 }
 
 }
@@ -8,21 +8,105 @@
 
 #include "ClientImpl.hpp"
 
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <random>
+#include <vector>
+
 namespace YP {
 
+/**
+ * @brief Provider to which requests may be sent, along with
+ * the statistics the client keeps about it.
+ */
+struct Target {
+    tl::provider_handle            m_ph;
+    std::shared_ptr<ProviderStats> m_stats;
+};
+
+/**
+ * @brief Routing configuration of a PhonebookHandle. Instances are
+ * never modified once published, so a request can keep using the one
+ * it started with while setReplicas or setHedging installs a new one.
+ */
+struct Routing {
+    std::vector<Target>                       m_targets; // this phonebook, then its replicas
+    bool                                      m_hedge = false;
+    Target                                    m_hedge_target;
+    std::chrono::duration<double, std::milli> m_hedge_delay{0};
+};
+
 class PhonebookHandleImpl {
 
     public:
 
-    std::shared_ptr<ClientImpl> m_client;
-    tl::provider_handle         m_ph;
+    std::shared_ptr<ClientImpl>    m_client;
+    tl::provider_handle            m_ph;
+    std::shared_ptr<ProviderStats> m_stats;
+
+    std::shared_ptr<const Routing> m_routing; // accessed with std::atomic_load/store
+    tl::mutex                      m_routing_mtx;
 
     PhonebookHandleImpl() = default;
 
     PhonebookHandleImpl(std::shared_ptr<ClientImpl> client,
-                       tl::provider_handle&& ph)
+                       tl::provider_handle&& ph,
+                       std::shared_ptr<ProviderStats> stats)
     : m_client(std::move(client))
-    , m_ph(std::move(ph)) {}
+    , m_ph(std::move(ph))
+    , m_stats(std::move(stats)) {
+        auto routing = std::make_shared<Routing>();
+        routing->m_targets.push_back(Target{m_ph, m_stats});
+        m_routing = std::move(routing);
+    }
+
+    std::shared_ptr<const Routing> routing() const {
+        return std::atomic_load(&m_routing);
+    }
+
+    /**
+     * @brief Publishes a copy of the current routing configuration
+     * modified by the provided function.
+     */
+    template<typename F>
+    void updateRouting(F&& update) {
+        std::lock_guard<tl::mutex> lock{m_routing_mtx};
+        auto routing = std::make_shared<Routing>(*m_routing);
+        update(*routing);
+        std::atomic_store(&m_routing, std::shared_ptr<const Routing>{std::move(routing)});
+    }
+
+    /**
+     * @brief Picks the phonebook to which to send a read request
+     * among this one and its replicas, using the power of two choices.
+     */
+    static const Target& pickReplica(const Routing& routing) {
+        auto& targets = routing.m_targets;
+        if(targets.size() == 1) return targets[0];
+        thread_local std::minstd_rand rng{std::random_device{}()};
+        auto n = targets.size();
+        auto i = rng() % n;
+        auto j = (i + 1 + rng() % (n - 1)) % n;
+        return targets[i].m_stats->load() <= targets[j].m_stats->load() ? targets[i] : targets[j];
+    }
+
+    /**
+     * @brief Picks the phonebook to which to send the hedge of a request
+     * sent to primary: the hedging replica, unless it is the primary, in
+     * which case the least loaded of the other replicas. Returns null if
+     * hedging is disabled or there is no other phonebook to hedge to.
+     */
+    static const Target* pickHedgeTarget(const Routing& routing, const Target& primary) {
+        if(!routing.m_hedge) return nullptr;
+        if(routing.m_hedge_target.m_stats != primary.m_stats) return &routing.m_hedge_target;
+        const Target* best = nullptr;
+        for(auto& target : routing.m_targets) {
+            if(target.m_stats == primary.m_stats) continue;
+            if(!best || target.m_stats->load() < best->m_stats->load()) best = &target;
+        }
+        return best;
+    }
 };
 
 }
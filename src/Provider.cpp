@@ -6,6 +6,7 @@
 #include "YP/Provider.hpp"
 
 #include "ProviderImpl.hpp"
+#include "Tracing.hpp"
 
 #include <thallium/serialization/stl/string.hpp>
 
@@ -34,6 +35,19 @@ std::string Provider::getConfig() const {
     return self ? self->getConfig() : "{}";
 }
 
+std::string Provider::getTraces() const {
+    if(!self) return Tracer::dump("YP provider");
+    return Tracer::dump("YP provider " + static_cast<std::string>(self->get_engine().self()));
+}
+
+std::string Provider::getAllocationStats() const {
+    return self ? self->getAllocationStats() : "{}";
+}
+
+void Provider::changePool(const tl::pool& pool) {
+    if(self) self->changePool(pool);
+}
+
 Provider::operator bool() const {
     return static_cast<bool>(self);
 }
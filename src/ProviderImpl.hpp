@@ -7,6 +7,8 @@
 #define __YP_PROVIDER_IMPL_H
 
 #include "YP/PhonebookInterface.hpp"
+#include "Tracing.hpp"
+#include "AllocProfiler.hpp"
 
 #include <thallium.hpp>
 #include <thallium/serialization/stl/string.hpp>
@@ -15,7 +17,12 @@
 #include <nlohmann/json.hpp>
 #include <spdlog/spdlog.h>
 
+#include <atomic>
+#include <functional>
 #include <tuple>
+#include <utility>
+#include <chrono>
+#include <dlfcn.h>
 
 namespace YP {
 
@@ -48,19 +55,106 @@ class ProviderImpl : public tl::provider<ProviderImpl> {
 
     tl::engine           m_engine;
     tl::pool             m_pool;
-    // Client RPC
-    tl::auto_remote_procedure m_compute_sum;
+    tl::mutex            m_pool_mtx;
+    // Client RPC, along with the number of its handlers currently
+    // running for the pool it is registered with
+    std::shared_ptr<std::atomic<uint64_t>> m_compute_sum_in_flight;
+    tl::remote_procedure                   m_compute_sum;
+    // Monitoring RPC, served by the engine's handler pool so that it
+    // answers even when m_pool is saturated and is not moved by changePool
+    tl::remote_procedure                   m_get_alloc_stats;
     // FIXME: other RPCs go here ...
     // PhonebookInterfaces
     std::shared_ptr<PhonebookInterface> m_backend;
+    bool                                m_attached = false;
+    std::string                         m_library;
+    // Allocation counters
+    bool                                m_profile_allocations = false;
+    AllocCounters                       m_compute_sum_allocs;
 
     ProviderImpl(const tl::engine& engine, uint16_t provider_id, const std::string& config, const tl::pool& pool)
     : tl::provider<ProviderImpl>(engine, provider_id, "YP")
     , m_engine(engine)
     , m_pool(pool)
-    , m_compute_sum(define("YP_compute_sum",  &ProviderImpl::computeSumRPC, pool))
+    , m_compute_sum_in_flight(std::make_shared<std::atomic<uint64_t>>(0))
+    , m_compute_sum(define("YP_compute_sum", computeSumHandler(m_compute_sum_in_flight), pool))
+    , m_get_alloc_stats(define("YP_get_alloc_stats", &ProviderImpl::getAllocationStatsRPC))
     {
         trace("Registered provider with id {}", get_provider_id());
+        // The destructor does not run if the constructor throws,
+        // so the RPCs have to be deregistered here.
+        try {
+            configure(config);
+        } catch(...) {
+            m_compute_sum.deregister();
+            m_get_alloc_stats.deregister();
+            throw;
+        }
+    }
+
+    ~ProviderImpl() {
+        trace("Deregistering provider");
+        m_compute_sum.deregister();
+        m_get_alloc_stats.deregister();
+        if(m_backend && !m_attached) {
+            m_backend->destroy();
+        }
+    }
+
+    std::string getConfig() const {
+        auto config = json::object();
+        if(m_profile_allocations) config["profile_allocations"] = true;
+        if(m_backend) {
+            config["phonebook"] = json::object();
+            auto phonebook_config = json::object();
+            phonebook_config["type"] = m_backend->name();
+            if(m_attached) phonebook_config["open"] = true;
+            if(!m_library.empty()) phonebook_config["library"] = m_library;
+            phonebook_config["config"] = json::parse(m_backend->getConfig());
+            config["phonebook"] = std::move(phonebook_config);
+        }
+        return config.dump();
+    }
+
+    std::string getAllocationStats() const {
+        auto rpcs = json::object();
+        auto add_counters = [&rpcs](const char* rpc_name, const AllocCounters& counters) {
+            rpcs[rpc_name] = {
+                {"count", counters.count.load(std::memory_order_relaxed)},
+                {"bytes", counters.bytes.load(std::memory_order_relaxed)}
+            };
+        };
+        add_counters("YP_compute_sum", m_compute_sum_allocs);
+        return json{
+            {"enabled", m_profile_allocations},
+            {"hooked",  AllocProfiler::hooked()},
+            {"rpcs",    std::move(rpcs)}
+        }.dump();
+    }
+
+    void changePool(const tl::pool& pool) {
+        std::lock_guard<tl::mutex> lock{m_pool_mtx};
+        // RPCs are bound to a pool when they are defined, so they have
+        // to be registered again. Requests arriving in between fail, so
+        // the new handler is built first to keep that window short.
+        auto in_flight = std::make_shared<std::atomic<uint64_t>>(0);
+        auto handler   = computeSumHandler(in_flight);
+        m_compute_sum.deregister();
+        m_compute_sum = define("YP_compute_sum", handler, pool);
+        auto old_pool = std::exchange(m_pool, pool);
+        auto old_in_flight = std::exchange(m_compute_sum_in_flight, std::move(in_flight));
+        // Handlers queued in the old pool before the RPC was deregistered
+        // are scheduled before a ULT pushed now (pools are FIFO), then
+        // those still running are waited for, so that the caller may
+        // destroy the old pool once this function returns.
+        if(!old_pool) old_pool = m_engine.get_handler_pool();
+        old_pool.make_thread([](){})->join();
+        while(old_in_flight->load(std::memory_order_acquire) != 0)
+            tl::thread::sleep(m_engine, 1.0);
+        trace("Changed provider's pool");
+    }
+
+    void configure(const std::string& config) {
         json json_config;
         try {
             json_config = json::parse(config);
@@ -69,34 +163,63 @@ class ProviderImpl : public tl::provider<ProviderImpl> {
             return;
         }
         if(!json_config.is_object()) return;
+        if(json_config.contains("profile_allocations") && json_config["profile_allocations"].is_boolean()) {
+            m_profile_allocations = json_config["profile_allocations"].get<bool>();
+            if(m_profile_allocations && !AllocProfiler::available())
+                warn("Allocation profiling requested but YP was built without ENABLE_ALLOC_PROFILING");
+            else if(m_profile_allocations && !AllocProfiler::hooked())
+                warn("Allocation profiling requested but operator new is not replaced"
+                     " (LD_PRELOAD libYP-alloc-hook.so when YP is dlopened)");
+        }
         if(!json_config.contains("phonebook")) return;
         auto& phonebook = json_config["phonebook"];
         if(!phonebook.is_object()) return;
+        if(phonebook.contains("library") && phonebook["library"].is_string()) {
+            auto& library = phonebook["library"].get_ref<const std::string&>();
+            loadLibrary(library).check();
+        }
         if(phonebook.contains("type") && phonebook["type"].is_string()) {
             auto& phonebook_type = phonebook["type"].get_ref<const std::string&>();
             auto phonebook_config = phonebook.contains("config") ? phonebook["config"] : json::object();
-            auto result = createPhonebook(phonebook_type, phonebook_config);
+            bool open = phonebook.contains("open") && phonebook["open"].is_boolean()
+                      && phonebook["open"].get<bool>();
+            auto result = open ? openPhonebook(phonebook_type, phonebook_config)
+                               : createPhonebook(phonebook_type, phonebook_config);
             result.check();
         }
     }
 
-    ~ProviderImpl() {
-        trace("Deregistering provider");
-        if(m_backend) {
-            m_backend->destroy();
-        }
+    using ComputeSumHandler = std::function<void(const tl::request&, int32_t, int32_t, uint64_t, uint64_t)>;
+
+    ComputeSumHandler computeSumHandler(std::shared_ptr<std::atomic<uint64_t>> in_flight) {
+        return [this, in_flight=std::move(in_flight)](const tl::request& req,
+                int32_t x, int32_t y, uint64_t deadline_us, uint64_t trace_id) {
+            struct InFlight {
+                std::atomic<uint64_t>& count;
+                InFlight(std::atomic<uint64_t>& c) : count(c) { count.fetch_add(1, std::memory_order_relaxed); }
+                ~InFlight() { count.fetch_sub(1, std::memory_order_release); }
+            } guard{*in_flight};
+            computeSumRPC(req, x, y, deadline_us, trace_id);
+        };
     }
 
-    std::string getConfig() const {
-        auto config = json::object();
-        if(m_backend) {
-            config["phonebook"] = json::object();
-            auto phonebook_config = json::object();
-            phonebook_config["type"] = m_backend->name();
-            phonebook_config["config"] = json::parse(m_backend->getConfig());
-            config["phonebook"] = std::move(phonebook_config);
+    Result<bool> loadLibrary(const std::string& library) {
+
+        Result<bool> result;
+
+        // The handle is never closed: the library's backend registration
+        // stores functions into the PhonebookFactory that must outlive us.
+        void* handle = dlopen(library.c_str(), RTLD_NOW | RTLD_GLOBAL);
+        if(!handle) {
+            result.success() = false;
+            result.error() = "Could not load library "s + library + ": " + dlerror();
+            error("{}", result.error());
+            return result;
         }
-        return config.dump();
+
+        m_library = library;
+        trace("Successfully loaded library {}", library);
+        return result;
     }
 
     Result<bool> createPhonebook(const std::string& phonebook_type,
@@ -125,16 +248,75 @@ class ProviderImpl : public tl::provider<ProviderImpl> {
         return result;
     }
 
+    Result<bool> openPhonebook(const std::string& phonebook_type,
+                               const json& phonebook_config) {
+
+        Result<bool> result;
+
+        try {
+            m_backend = PhonebookFactory::openPhonebook(phonebook_type, get_engine(), phonebook_config);
+        } catch(const std::exception& ex) {
+            result.success() = false;
+            result.error() = ex.what();
+            error("Error when opening phonebook of type {}: {}",
+                  phonebook_type, result.error());
+            return result;
+        }
+
+        if(not m_backend) {
+            result.success() = false;
+            result.error() = "Unknown phonebook type "s + phonebook_type;
+            error("Unknown phonebook type {}", phonebook_type);
+            return result;
+        }
+
+        m_attached = true;
+        trace("Successfully opened phonebook of type {}", phonebook_type);
+        return result;
+    }
+
+    static bool deadlineExpired(uint64_t deadline_us) {
+        if(deadline_us == 0) return false;
+        auto now = std::chrono::system_clock::now().time_since_epoch();
+        return (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(now).count() > deadline_us;
+    }
+
+    void getAllocationStatsRPC(const tl::request& req) {
+        trace("Received getAllocationStats request");
+        Result<std::string> result;
+        tl::auto_respond<decltype(result)> response{req, result};
+        result.value() = getAllocationStats();
+    }
+
     void computeSumRPC(const tl::request& req,
-                       int32_t x, int32_t y) {
-        trace("Received computeSum request");
+                       int32_t x, int32_t y, uint64_t deadline_us,
+                       uint64_t trace_id) {
+        // declared first so that it also covers sending the response
+        AllocProfiler::Scope alloc_scope{m_profile_allocations ? &m_compute_sum_allocs : nullptr};
         Result<int32_t> result;
-        tl::auto_respond<decltype(result)> response{req, result};
-        if(!m_backend) {
-            result.success() = false;
-            result.error() = "Provider has no phonebook attached";
-        } else {
-            result = m_backend->computeSum(x, y);
+        {
+            // starts when the handler runs, so time spent queued in m_pool
+            // shows up as network time in the client's span, not in this one
+            TraceSpan handler_span{trace_id, "YP_compute_sum:provider"};
+            trace("Received computeSum request");
+            if(!m_backend) {
+                result.success() = false;
+                result.code() = ErrorCode::NoPhonebook;
+                result.error() = "Provider has no phonebook attached";
+            } else if(deadlineExpired(deadline_us)) {
+                result.success() = false;
+                result.code() = ErrorCode::DeadlineExpired;
+                result.error() = "Request deadline has passed";
+                debug("Dropped computeSum request past its deadline");
+            } else {
+                TraceSpan backend_span{trace_id, "YP_compute_sum:backend"};
+                result = m_backend->computeSum(x, y);
+            }
+        }
+        {
+            // serializing and sending the response, in its own span
+            TraceSpan respond_span{trace_id, "YP_compute_sum:respond"};
+            req.respond(result);
         }
         trace("Successfully executed computeSum");
     }
@@ -0,0 +1,206 @@
+/*
+ * (C) 2024 The University of Chicago
+ *
+ * See COPYRIGHT in top-level directory.
+ */
+#ifndef __YP_TRACING_H
+#define __YP_TRACING_H
+
+#include <nlohmann/json.hpp>
+#include <unistd.h>
+#include <sys/syscall.h>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <vector>
+
+namespace YP {
+
+/**
+ * @brief Timestamped span of a sampled request. The name
+ * must be a string literal (it is not copied).
+ */
+struct TraceEvent {
+    uint64_t    trace_id = 0;
+    const char* name     = nullptr;
+    uint64_t    start_us = 0;
+    uint64_t    end_us   = 0;
+};
+
+/**
+ * @brief Fixed-size ring of TraceEvents. Each thread (hence each
+ * Argobots execution stream) records into its own ring, so recording
+ * takes no lock. Old events are overwritten when the ring is full.
+ *
+ * Each slot is protected by a sequence number: it is odd while the
+ * owner writes the slot, and 2*(i+1) once the slot holds the i-th
+ * event. Readers copy the slot and discard it if the sequence number
+ * was not the expected one or changed while they were copying it.
+ */
+class TraceRing {
+
+    public:
+
+    static constexpr size_t capacity = 4096;
+
+    const uint64_t tid = static_cast<uint64_t>(syscall(SYS_gettid));
+
+    void record(const TraceEvent& event) {
+        auto head  = m_head.load(std::memory_order_relaxed);
+        auto& slot = m_slots[head % capacity];
+        slot.seq.store(2*head + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        slot.trace_id.store(event.trace_id, std::memory_order_relaxed);
+        slot.name.store(event.name, std::memory_order_relaxed);
+        slot.start_us.store(event.start_us, std::memory_order_relaxed);
+        slot.end_us.store(event.end_us, std::memory_order_relaxed);
+        slot.seq.store(2*head + 2, std::memory_order_release);
+        m_head.store(head + 1, std::memory_order_release);
+    }
+
+    std::vector<TraceEvent> events() const {
+        auto head  = m_head.load(std::memory_order_acquire);
+        auto first = head > capacity ? head - capacity : 0;
+        std::vector<TraceEvent> result;
+        result.reserve(head - first);
+        for(auto i = first; i < head; i++) {
+            auto& slot = m_slots[i % capacity];
+            auto seq = slot.seq.load(std::memory_order_acquire);
+            if(seq != 2*i + 2) continue; // overwritten by a newer event
+            TraceEvent event;
+            event.trace_id = slot.trace_id.load(std::memory_order_relaxed);
+            event.name     = slot.name.load(std::memory_order_relaxed);
+            event.start_us = slot.start_us.load(std::memory_order_relaxed);
+            event.end_us   = slot.end_us.load(std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if(slot.seq.load(std::memory_order_relaxed) != seq) continue;
+            result.push_back(event);
+        }
+        return result;
+    }
+
+    private:
+
+    struct Slot {
+        std::atomic<uint64_t>    seq{0};
+        std::atomic<uint64_t>    trace_id{0};
+        std::atomic<const char*> name{nullptr};
+        std::atomic<uint64_t>    start_us{0};
+        std::atomic<uint64_t>    end_us{0};
+    };
+
+    std::array<Slot, capacity> m_slots;
+    std::atomic<uint64_t>      m_head{0};
+};
+
+class Tracer {
+
+    public:
+
+    static uint64_t now() {
+        auto t = std::chrono::system_clock::now().time_since_epoch();
+        return std::chrono::duration_cast<std::chrono::microseconds>(t).count();
+    }
+
+    /**
+     * @brief Returns a new trace id with the given probability, 0 otherwise.
+     */
+    static uint64_t sample(double rate) {
+        if(rate <= 0.0) return 0;
+        thread_local std::mt19937_64 rng{std::random_device{}()};
+        if(rate < 1.0 && std::uniform_real_distribution<double>{}(rng) >= rate) return 0;
+        uint64_t id;
+        do { id = rng(); } while(id == 0);
+        return id;
+    }
+
+    static void record(const TraceEvent& event) {
+        thread_local std::shared_ptr<TraceRing> ring = instance().addRing();
+        ring->record(event);
+    }
+
+    /**
+     * @brief Exports the recorded events in the Chrome trace event
+     * format, which can be loaded in chrome://tracing or Perfetto.
+     * Events carry the process and thread ids, and the process is
+     * named process_name, so that the traces of several processes
+     * can be merged.
+     */
+    static std::string dump(const std::string& process_name) {
+        auto& self = instance();
+        auto pid = static_cast<uint64_t>(getpid());
+        auto events = nlohmann::json::array();
+        events.push_back({
+            {"name", "process_name"},
+            {"ph",   "M"},
+            {"pid",  pid},
+            {"args", {{"name", process_name}}}
+        });
+        std::lock_guard<std::mutex> lock{self.m_rings_mtx};
+        for(auto& ring : self.m_rings) {
+            for(auto& event : ring->events()) {
+                events.push_back({
+                    {"name", event.name},
+                    {"ph",   "X"},
+                    {"ts",   event.start_us},
+                    {"dur",  event.end_us - event.start_us},
+                    {"pid",  pid},
+                    {"tid",  ring->tid},
+                    {"args", {{"trace_id", event.trace_id}}}
+                });
+            }
+        }
+        return nlohmann::json{{"traceEvents", std::move(events)}}.dump();
+    }
+
+    private:
+
+    static Tracer& instance() {
+        static Tracer tracer;
+        return tracer;
+    }
+
+    std::shared_ptr<TraceRing> addRing() {
+        auto ring = std::make_shared<TraceRing>();
+        std::lock_guard<std::mutex> lock{m_rings_mtx};
+        m_rings.push_back(ring);
+        return ring;
+    }
+
+    std::vector<std::shared_ptr<TraceRing>> m_rings;
+    std::mutex                              m_rings_mtx;
+};
+
+/**
+ * @brief Records a TraceEvent covering its own lifetime,
+ * if the trace id is not 0.
+ */
+class TraceSpan {
+
+    public:
+
+    TraceSpan(uint64_t trace_id, const char* name)
+    : m_event{trace_id, name, trace_id ? Tracer::now() : 0, 0} {}
+
+    TraceSpan(const TraceSpan&) = delete;
+    TraceSpan& operator=(const TraceSpan&) = delete;
+
+    ~TraceSpan() {
+        if(!m_event.trace_id) return;
+        m_event.end_us = Tracer::now();
+        Tracer::record(m_event);
+    }
+
+    private:
+
+    TraceEvent m_event;
+};
+
+}
+
+#endif
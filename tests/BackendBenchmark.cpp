@@ -0,0 +1,59 @@
+/*
+ * (C) 2024 The University of Chicago
+ *
+ * See COPYRIGHT in top-level directory.
+ */
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/catch_all.hpp>
+#include "Ensure.hpp"
+#include <YP/Client.hpp>
+#include <YP/Provider.hpp>
+#include <YP/PhonebookInterface.hpp>
+
+/**
+ * @brief Same computation as DummyPhonebook::computeSum, but called
+ * through its static type, so the call can be inlined. This is what
+ * a provider templated on its backend type would achieve.
+ */
+struct InlinePhonebook {
+    YP::Result<int32_t> computeSum(int32_t x, int32_t y) {
+        YP::Result<int32_t> result;
+        result.value() = x + y;
+        return result;
+    }
+};
+
+/*
+ * Hidden from the default test run, use ./BackendBenchmark "[benchmark]".
+ */
+TEST_CASE("Backend dispatch benchmark", "[.][benchmark]") {
+    auto engine = thallium::engine("na+sm", THALLIUM_SERVER_MODE);
+    ENSURE(engine.finalize());
+    const auto provider_config = R"(
+    {
+        "phonebook": {
+            "type": "dummy",
+            "config": {}
+        }
+    }
+    )";
+    YP::Provider provider(engine, 42, provider_config);
+    YP::Client client(engine);
+    auto rh = client.makePhonebookHandle(engine.self(), 42);
+
+    auto dynamic = YP::PhonebookFactory::createPhonebook("dummy", engine, nlohmann::json::object());
+    InlinePhonebook direct;
+    int32_t x = 42;
+
+    BENCHMARK("virtual computeSum") {
+        return dynamic->computeSum(x, 51).value();
+    };
+
+    BENCHMARK("inlined computeSum") {
+        return direct.computeSum(x, 51).value();
+    };
+
+    BENCHMARK("computeSum RPC") {
+        return rh.computeSum(x, 51).wait();
+    };
+}
@@ -9,6 +9,8 @@
 #include <YP/Client.hpp>
 #include <YP/Provider.hpp>
 #include <YP/PhonebookHandle.hpp>
+#include <cstdio>
+#include <fstream>
 
 TEST_CASE("Client test", "[client]") {
 
@@ -37,4 +39,38 @@ TEST_CASE("Client test", "[client]") {
         REQUIRE_THROWS_AS(client.makePhonebookHandle(addr, 55), YP::Exception);
         REQUIRE_NOTHROW(client.makePhonebookHandle(addr, 55, false));
     }
+
+    SECTION("Open group") {
+
+        YP::Client client(engine);
+        std::string addr = engine.self();
+
+        const char* filename = "ClientTest-group.json";
+        ENSURE(std::remove(filename));
+        {
+            auto group = nlohmann::json::object();
+            group["providers"] = nlohmann::json::array();
+            group["providers"].push_back({{"address", addr}, {"provider_id", 42}});
+            group["providers"].push_back({{"address", addr}, {"provider_id", 42}});
+            std::ofstream(filename) << group.dump();
+        }
+
+        std::vector<YP::PhonebookHandle> phonebooks;
+        REQUIRE_NOTHROW(phonebooks = client.openGroup(filename));
+        REQUIRE(phonebooks.size() == 2);
+        for(auto& phonebook : phonebooks) {
+            REQUIRE(static_cast<bool>(phonebook));
+            REQUIRE(phonebook.computeSum(42, 51).wait() == 93);
+        }
+
+        REQUIRE_THROWS_AS(client.openGroup("does-not-exist.json"), YP::Exception);
+
+        {
+            auto group = nlohmann::json::object();
+            group["providers"] = nlohmann::json::array();
+            group["providers"].push_back({{"address", addr}, {"provider_id", 65536 + 42}});
+            std::ofstream(filename) << group.dump();
+        }
+        REQUIRE_THROWS_AS(client.openGroup(filename), YP::Exception);
+    }
 }
@@ -8,6 +8,57 @@
 #include "Ensure.hpp"
 #include <YP/Client.hpp>
 #include <YP/Provider.hpp>
+#include <unistd.h>
+#include <mutex>
+#include <vector>
+
+/**
+ * @brief Matches a YP::Exception carrying the given error code.
+ */
+static auto HasErrorCode(YP::ErrorCode code) {
+    return Catch::Matchers::Predicate<YP::Exception>(
+        [code](const YP::Exception& ex) { return ex.code() == code; },
+        "has the expected error code");
+}
+
+/**
+ * @brief Registers a YP_compute_sum handler that holds on to the
+ * requests it receives instead of answering them, until release()
+ * answers them with the given sum.
+ */
+struct StalledProvider {
+
+    thallium::remote_procedure     m_rpc;
+    std::vector<thallium::request> m_requests;
+    thallium::mutex                m_mtx;
+
+    StalledProvider(thallium::engine& engine, uint16_t provider_id)
+    : m_rpc(engine.define("YP_compute_sum",
+        std::function<void(const thallium::request&, int32_t, int32_t, uint64_t, uint64_t)>{
+            [this](const thallium::request& req, int32_t, int32_t, uint64_t, uint64_t) {
+                std::lock_guard<thallium::mutex> lock{m_mtx};
+                m_requests.push_back(req);
+            }}, provider_id)) {}
+
+    ~StalledProvider() {
+        m_rpc.deregister();
+    }
+
+    size_t pending() {
+        std::lock_guard<thallium::mutex> lock{m_mtx};
+        return m_requests.size();
+    }
+
+    void release(int32_t sum) {
+        std::lock_guard<thallium::mutex> lock{m_mtx};
+        for(auto& req : m_requests) {
+            YP::Result<int32_t> result;
+            result.value() = sum;
+            req.respond(result);
+        }
+        m_requests.clear();
+    }
+};
 
 TEST_CASE("Phonebook test", "[phonebook]") {
     auto engine = thallium::engine("na+sm", THALLIUM_SERVER_MODE);
@@ -33,5 +84,312 @@ TEST_CASE("Phonebook test", "[phonebook]") {
             REQUIRE_NOTHROW([&]() { result = rh.computeSum(42, 51).wait(); }());
             REQUIRE(result == 93);
         }
+
+        SECTION("Send Sum RPC with deadline") {
+            int32_t result;
+            REQUIRE_NOTHROW([&]() {
+                result = rh.computeSum(42, 51, std::chrono::seconds(10)).wait();
+            }());
+            REQUIRE(result == 93);
+            REQUIRE_THROWS_MATCHES(rh.computeSum(42, 51, std::chrono::milliseconds(-1)).wait(),
+                                   YP::Exception, HasErrorCode(YP::ErrorCode::DeadlineExpired));
+        }
+
+        SECTION("Send Sum RPC to a provider without phonebook") {
+            YP::Provider empty_provider(engine, 44, "{}");
+            auto empty_rh = client.makePhonebookHandle(addr, 44);
+            REQUIRE_THROWS_MATCHES(empty_rh.computeSum(42, 51).wait(),
+                                   YP::Exception, HasErrorCode(YP::ErrorCode::NoPhonebook));
+            try {
+                empty_rh.computeSum(42, 51).wait();
+            } catch(const YP::Exception& ex) {
+                REQUIRE(std::string{ex.what()} == "Provider has no phonebook attached");
+            }
+        }
+
+        SECTION("Send Sum RPC that times out") {
+            StalledProvider stalled(engine, 43);
+            auto stalled_rh = client.makePhonebookHandle(addr, 43, false);
+            auto future = stalled_rh.computeSum(42, 51, std::chrono::milliseconds(100));
+            auto start = std::chrono::steady_clock::now();
+            REQUIRE_THROWS_MATCHES(future.wait(), YP::Exception, HasErrorCode(YP::ErrorCode::Timeout));
+            REQUIRE(std::chrono::steady_clock::now() - start < std::chrono::seconds(5));
+            start = std::chrono::steady_clock::now();
+            REQUIRE_THROWS_MATCHES(future.wait(), YP::Exception, HasErrorCode(YP::ErrorCode::Timeout));
+            REQUIRE(std::chrono::steady_clock::now() - start < std::chrono::milliseconds(100));
+        }
+
+        SECTION("Wait on Sum RPC with a timeout") {
+            StalledProvider stalled(engine, 43);
+            auto stalled_rh = client.makePhonebookHandle(addr, 43, false);
+            auto future = stalled_rh.computeSum(42, 51);
+            REQUIRE_THROWS_MATCHES(future.wait(std::chrono::milliseconds(50)),
+                                   YP::Exception, HasErrorCode(YP::ErrorCode::Timeout));
+            REQUIRE_THROWS_MATCHES(future.wait(std::chrono::milliseconds(50)),
+                                   YP::Exception, HasErrorCode(YP::ErrorCode::Timeout));
+            stalled.release(93);
+            REQUIRE(future.wait(std::chrono::seconds(10)) == 93);
+            REQUIRE(future.wait() == 93);
+        }
+
+        SECTION("Cancel Sum RPC") {
+            auto future = rh.computeSum(42, 51);
+            future.cancel();
+            REQUIRE_THROWS_AS(future.wait(), YP::Exception);
+            auto completed = rh.computeSum(42, 51);
+            REQUIRE(completed.wait() == 93);
+            completed.cancel();
+            REQUIRE(completed.wait() == 93);
+        }
+
+        SECTION("Send traced Sum RPC") {
+            client.setTraceSampleRate(1.0);
+            REQUIRE(rh.computeSum(42, 51).wait() == 93);
+            auto event_names = [](const std::string& traces) {
+                std::unordered_set<std::string> names;
+                for(auto& event : nlohmann::json::parse(traces)["traceEvents"])
+                    names.insert(event["name"].get<std::string>());
+                return names;
+            };
+            REQUIRE(event_names(client.getTraces()).count("YP_compute_sum:client") == 1);
+            auto provider_events = event_names(provider.getTraces());
+            REQUIRE(provider_events.count("YP_compute_sum:backend") == 1);
+            // the respond span is recorded once the response has been sent
+            for(int i = 0; i < 1000 && !provider_events.count("YP_compute_sum:respond"); i++) {
+                thallium::thread::sleep(engine, 1.0);
+                provider_events = event_names(provider.getTraces());
+            }
+            REQUIRE(provider_events.count("YP_compute_sum:respond") == 1);
+            // events carry the real process id, which is named in a metadata event
+            bool named = false;
+            for(auto& event : nlohmann::json::parse(provider.getTraces())["traceEvents"]) {
+                REQUIRE(event["pid"].get<uint64_t>() == static_cast<uint64_t>(getpid()));
+                if(event["ph"] == "M" && event["name"] == "process_name") named = true;
+            }
+            REQUIRE(named);
+        }
+
+        SECTION("Send hedged Sum RPC") {
+            StalledProvider stalled(engine, 43);
+            auto stalled_rh = client.makePhonebookHandle(addr, 43, false);
+            stalled_rh.setHedging(rh, std::chrono::milliseconds(10));
+            int32_t result;
+            REQUIRE_NOTHROW([&]() { result = stalled_rh.computeSum(42, 51).wait(); }());
+            REQUIRE(result == 93);
+            stalled.release(-1);
+        }
+
+        SECTION("Hedging does not delay fast responses") {
+            rh.setHedging(client.makePhonebookHandle(addr, 43, false), std::chrono::milliseconds(100));
+            REQUIRE(rh.computeSum(42, 51).wait() == 93);
+            auto start = std::chrono::steady_clock::now();
+            for(int i = 0; i < 10; i++)
+                REQUIRE(rh.computeSum(42, i).wait() == 42 + i);
+            // no response may wait for (a fraction of) the hedge delay
+            REQUIRE(std::chrono::steady_clock::now() - start < std::chrono::milliseconds(100));
+            // let the ULTs that would send the hedges wake up and exit
+            thallium::thread::sleep(engine, 150);
+        }
+
+        SECTION("Hedge to a replica other than the one picked") {
+            StalledProvider stalled(engine, 43);
+            auto stalled_rh = client.makePhonebookHandle(addr, 43, false);
+            // gives provider 42 a non-zero latency, so that 43 is picked
+            REQUIRE(rh.computeSum(42, 51).wait() == 93);
+            auto balanced_rh = client.makePhonebookHandle(addr, 43, false);
+            balanced_rh.setReplicas({rh});
+            balanced_rh.setHedging(stalled_rh, std::chrono::milliseconds(10));
+            // hedging to the stalled provider it was sent to would time out
+            int32_t result;
+            REQUIRE_NOTHROW([&]() {
+                result = balanced_rh.computeSum(42, 51, std::chrono::seconds(2)).wait();
+            }());
+            REQUIRE(result == 93);
+            stalled.release(-1);
+        }
+
+        SECTION("Send Sum RPCs to replicas") {
+            rh.setReplicas({client.makePhonebookHandle(addr, 42),
+                            client.makePhonebookHandle(addr, 42)});
+            for(int i = 0; i < 16; i++) {
+                int32_t result;
+                REQUIRE_NOTHROW([&]() { result = rh.computeSum(42, i).wait(); }());
+                REQUIRE(result == 42 + i);
+            }
+        }
+
+        SECTION("Pick the least loaded replica") {
+            // replica holding on to its requests, so that we can count those routed to it
+            StalledProvider stalled(engine, 46);
+            auto stalled_rh = client.makePhonebookHandle(addr, 46);
+            auto direct_rh  = client.makePhonebookHandle(addr, 42);
+            rh.setReplicas({stalled_rh});
+            // requests kept outstanding on provider 42 make the other replica preferred
+            std::vector<YP::Future<int32_t>> outstanding, routed;
+            for(int i = 0; i < 64; i++) outstanding.push_back(direct_rh.computeSum(42, 51));
+            for(int i = 0; i < 16; i++) routed.push_back(rh.computeSum(42, i));
+            for(int i = 0; i < 1000 && stalled.pending() < 16; i++)
+                thallium::thread::sleep(engine, 1.0);
+            REQUIRE(stalled.pending() == 16);
+            stalled.release(93);
+            for(auto& f : routed) REQUIRE(f.wait() == 93);
+            for(auto& f : outstanding) REQUIRE(f.wait() == 93);
+        }
+
+        SECTION("Avoid a replica answering with errors") {
+            // provider without a phonebook, answering every request with an error
+            YP::Provider empty_provider(engine, 44, "{}");
+            auto empty_rh = client.makePhonebookHandle(addr, 44);
+            for(int i = 0; i < 8; i++)
+                REQUIRE_THROWS_AS(empty_rh.computeSum(42, 51).wait(), YP::Exception);
+            // its errors are fast, but must not make it look like the fastest replica
+            rh.setReplicas({empty_rh});
+            for(int i = 0; i < 16; i++)
+                REQUIRE(rh.computeSum(42, i).wait() == 42 + i);
+        }
+
+        SECTION("Change pool under traffic") {
+            auto pool    = thallium::pool::create(thallium::pool::access::mpmc);
+            auto xstream = thallium::xstream::create(thallium::scheduler::predef::deflt, *pool);
+            std::vector<YP::Future<int32_t>> futures;
+            for(int i = 0; i < 64; i++) futures.push_back(rh.computeSum(42, i));
+            REQUIRE_NOTHROW(provider.changePool(*pool));
+            for(int i = 64; i < 128; i++) futures.push_back(rh.computeSum(42, i));
+            REQUIRE_NOTHROW(provider.changePool(engine.get_handler_pool()));
+            // nothing is left running in the old pool once changePool returns
+            REQUIRE(pool->total_size() == 0);
+            // requests arriving while the RPC is registered again may fail
+            size_t succeeded = 0;
+            for(int i = 0; i < 128; i++) {
+                int32_t result;
+                try {
+                    result = futures[i].wait();
+                } catch(const std::exception&) {
+                    continue;
+                }
+                REQUIRE(result == 42 + i);
+                succeeded++;
+            }
+            REQUIRE(succeeded > 0);
+            for(int i = 0; i < 16; i++)
+                REQUIRE(rh.computeSum(42, i).wait() == 42 + i);
+        }
+
+        SECTION("Send Sum RPC after changing pool") {
+            REQUIRE_NOTHROW(provider.changePool(engine.get_handler_pool()));
+            int32_t result;
+            REQUIRE_NOTHROW([&]() { result = rh.computeSum(42, 51).wait(); }());
+            REQUIRE(result == 93);
+        }
+    }
+}
+
+TEST_CASE("Allocation profiling test", "[phonebook]") {
+    auto engine = thallium::engine("na+sm", THALLIUM_SERVER_MODE);
+    ENSURE(engine.finalize());
+    const auto provider_config = R"(
+    {
+        "profile_allocations": true,
+        "phonebook": {
+            "type": "dummy",
+            "config": {}
+        }
     }
+    )";
+    YP::Provider provider(engine, 42, provider_config);
+    YP::Client client(engine);
+    auto rh = client.makePhonebookHandle(engine.self(), 42);
+
+    REQUIRE(rh.computeSum(42, 51).wait() == 93);
+    auto stats = nlohmann::json::parse(provider.getAllocationStats());
+    REQUIRE(stats["enabled"].get<bool>());
+    REQUIRE(stats["rpcs"].contains("YP_compute_sum"));
+    REQUIRE(stats["rpcs"]["YP_compute_sum"]["count"].is_number());
+#ifdef YP_ENABLE_ALLOC_PROFILING
+    // this executable is linked against YP, so its operator new is in effect
+    REQUIRE(stats["hooked"].get<bool>());
+    REQUIRE(stats["rpcs"]["YP_compute_sum"]["count"].get<uint64_t>() > 0);
+    REQUIRE(stats["rpcs"]["YP_compute_sum"]["bytes"].get<uint64_t>() > 0);
+#else
+    REQUIRE(!stats["hooked"].get<bool>());
+#endif
+
+    SECTION("Get the statistics over RPC") {
+        auto remote_stats = nlohmann::json::parse(rh.getAllocationStats());
+        REQUIRE(remote_stats["enabled"].get<bool>());
+        REQUIRE(remote_stats["hooked"] == stats["hooked"]);
+        REQUIRE(remote_stats["rpcs"]["YP_compute_sum"]["count"].get<uint64_t>()
+             >= stats["rpcs"]["YP_compute_sum"]["count"].get<uint64_t>());
+    }
+}
+
+TEST_CASE("Attached phonebook test", "[phonebook]") {
+    auto engine = thallium::engine("na+sm", THALLIUM_SERVER_MODE);
+    ENSURE(engine.finalize());
+    const auto provider_config = R"(
+    {
+        "phonebook": {
+            "type": "dummy",
+            "open": true,
+            "config": {}
+        }
+    }
+    )";
+    YP::Provider provider(engine, 42, provider_config);
+
+    SECTION("Configuration reports attached phonebook") {
+        auto config = nlohmann::json::parse(provider.getConfig());
+        REQUIRE(config["phonebook"]["open"] == true);
+    }
+
+    SECTION("Send Sum RPC") {
+        YP::Client client(engine);
+        std::string addr = engine.self();
+
+        auto rh = client.makePhonebookHandle(addr, 42);
+
+        int32_t result;
+        REQUIRE_NOTHROW([&]() { result = rh.computeSum(42, 51).wait(); }());
+        REQUIRE(result == 93);
+    }
+}
+
+TEST_CASE("Phonebook library test", "[phonebook]") {
+    auto engine = thallium::engine("na+sm", THALLIUM_SERVER_MODE);
+    ENSURE(engine.finalize());
+    const auto provider_config = R"(
+    {
+        "phonebook": {
+            "type": "dummy",
+            "library": "libdoes-not-exist.so",
+            "config": {}
+        }
+    }
+    )";
+    REQUIRE_THROWS_AS(YP::Provider(engine, 42, provider_config), YP::Exception);
+}
+
+TEST_CASE("Phonebook plugin test", "[phonebook]") {
+    auto engine = thallium::engine("na+sm", THALLIUM_SERVER_MODE);
+    ENSURE(engine.finalize());
+    const auto provider_config = std::string{R"(
+    {
+        "phonebook": {
+            "type": "test",
+            "library": ")"} + YP_TEST_BACKEND_LIBRARY + R"(",
+            "config": {}
+        }
+    }
+    )";
+    YP::Provider provider(engine, 42, provider_config);
+
+    auto config = nlohmann::json::parse(provider.getConfig());
+    REQUIRE(config["phonebook"]["type"] == "test");
+    REQUIRE(config["phonebook"]["library"] == YP_TEST_BACKEND_LIBRARY);
+
+    YP::Client client(engine);
+    auto rh = client.makePhonebookHandle(engine.self(), 42);
+    int32_t result;
+    REQUIRE_NOTHROW([&]() { result = rh.computeSum(42, 51).wait(); }());
+    REQUIRE(result == 93);
 }
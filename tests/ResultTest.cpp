@@ -0,0 +1,105 @@
+/*
+ * (C) 2024 The University of Chicago
+ *
+ * See COPYRIGHT in top-level directory.
+ */
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/catch_all.hpp>
+#include <YP/Result.hpp>
+#include <cstring>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+/**
+ * @brief Minimal archives following the Thallium interface (operator&
+ * used for both directions), writing trivially copyable fields with a
+ * memcpy and strings as their size followed by their characters.
+ */
+struct OutputArchive {
+
+    std::vector<char> m_buffer;
+
+    template<typename T>
+    OutputArchive& operator&(T& t) {
+        if constexpr(std::is_same_v<T, std::string>) {
+            size_t size = t.size();
+            *this & size;
+            m_buffer.insert(m_buffer.end(), t.begin(), t.end());
+        } else if constexpr(std::is_trivially_copyable_v<T>) {
+            auto p = reinterpret_cast<const char*>(&t);
+            m_buffer.insert(m_buffer.end(), p, p + sizeof(T));
+        } else {
+            t.serialize(*this);
+        }
+        return *this;
+    }
+};
+
+struct InputArchive {
+
+    const std::vector<char>& m_buffer;
+    size_t                   m_pos = 0;
+
+    template<typename T>
+    InputArchive& operator&(T& t) {
+        if constexpr(std::is_same_v<T, std::string>) {
+            size_t size;
+            *this & size;
+            t.assign(m_buffer.data() + m_pos, size);
+            m_pos += size;
+        } else if constexpr(std::is_trivially_copyable_v<T>) {
+            std::memcpy(&t, m_buffer.data() + m_pos, sizeof(T));
+            m_pos += sizeof(T);
+        } else {
+            t.serialize(*this);
+        }
+        return *this;
+    }
+};
+
+TEST_CASE("Result test", "[result]") {
+
+    SECTION("Successful Result only carries the status and value") {
+        YP::Result<int32_t> result;
+        result.value() = 93;
+        OutputArchive out;
+        out & result;
+        REQUIRE(out.m_buffer.size() == sizeof(bool) + sizeof(int32_t));
+
+        YP::Result<int32_t> received;
+        InputArchive in{out.m_buffer};
+        in & received;
+        REQUIRE(in.m_pos == out.m_buffer.size());
+        REQUIRE(received.success());
+        REQUIRE(received.value() == 93);
+    }
+
+    SECTION("Failed Result carries its code and error") {
+        YP::Result<int32_t> result;
+        result.success() = false;
+        result.code()    = YP::ErrorCode::DeadlineExpired;
+        result.error()   = "Deadline expired";
+        OutputArchive out;
+        out & result;
+
+        YP::Result<int32_t> received;
+        InputArchive in{out.m_buffer};
+        in & received;
+        REQUIRE(in.m_pos == out.m_buffer.size());
+        REQUIRE(!received.success());
+        REQUIRE(received.code() == YP::ErrorCode::DeadlineExpired);
+        REQUIRE(received.error() == "Deadline expired");
+        try {
+            received.check();
+            FAIL("check() did not throw");
+        } catch(const YP::Exception& ex) {
+            REQUIRE(ex.code() == YP::ErrorCode::DeadlineExpired);
+            REQUIRE(std::string{ex.what()} == "Deadline expired");
+        }
+    }
+
+    SECTION("Exception defaults to a generic error code") {
+        REQUIRE(YP::Exception{"error"}.code() == YP::ErrorCode::Generic);
+    }
+}
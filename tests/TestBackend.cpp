@@ -0,0 +1,48 @@
+/*
+ * (C) 2024 The University of Chicago
+ *
+ * See COPYRIGHT in top-level directory.
+ */
+#include <YP/PhonebookInterface.hpp>
+
+using json = nlohmann::json;
+
+/**
+ * Backend built as a separate module, loaded by the provider
+ * through the "library" field of its configuration.
+ */
+class TestPhonebook : public YP::PhonebookInterface {
+
+    json m_config;
+
+    public:
+
+    TestPhonebook(const json& config)
+    : m_config(config) {}
+
+    std::string getConfig() const override {
+        return m_config.dump();
+    }
+
+    YP::Result<int32_t> computeSum(int32_t x, int32_t y) override {
+        YP::Result<int32_t> result;
+        result.value() = x + y;
+        return result;
+    }
+
+    YP::Result<bool> destroy() override {
+        return YP::Result<bool>{};
+    }
+
+    static std::unique_ptr<YP::PhonebookInterface> create(const thallium::engine& engine, const json& config) {
+        (void)engine;
+        return std::unique_ptr<YP::PhonebookInterface>(new TestPhonebook(config));
+    }
+
+    static std::unique_ptr<YP::PhonebookInterface> open(const thallium::engine& engine, const json& config) {
+        (void)engine;
+        return std::unique_ptr<YP::PhonebookInterface>(new TestPhonebook(config));
+    }
+};
+
+YP_REGISTER_BACKEND(test, TestPhonebook);